@@ -0,0 +1,289 @@
+// SPDX-License-Identifier: AGPL-3.0-only
+// Copyright (C) 2025 Cornelius Koepp
+
+#include "HomematicCcu.h"
+
+HomematicCcu::HomematicCcu(uint8_t index, const char *host, uint16_t port)
+{
+    _index = index;
+    _host = host;
+    _port = port;
+}
+
+const std::string HomematicCcu::logPrefix()
+{
+    return openknx.logger.buildPrefix("HMG-CCU", _index + 1);
+}
+
+bool HomematicCcu::isAvailable()
+{
+    return _failCount == 0 || delayCheckMillis(_lastFailure_millis, _retryDelay_millis);
+}
+
+bool HomematicCcu::enqueue(uint8_t channelIndex)
+{
+    if (_queueSize >= HMG_ChannelCount)
+    {
+        // can not happen, as every channel is queued at most once
+        logErrorP("queue full, ignore channel %u!", channelIndex + 1);
+        return false;
+    }
+    _queue[(_queueHead + _queueSize) % HMG_ChannelCount] = channelIndex;
+    _queueSize++;
+    return true;
+}
+
+int16_t HomematicCcu::dequeue()
+{
+    if (_queueSize == 0 || !isAvailable())
+        return -1;
+
+    const uint8_t channelIndex = _queue[_queueHead];
+    _queueHead = (_queueHead + 1) % HMG_ChannelCount;
+    _queueSize--;
+    return channelIndex;
+}
+
+bool HomematicCcu::isDutyCycleRequestDue()
+{
+    return _used && ParamHMG_DutyCycleInterval > 0 && isAvailable() &&
+           delayCheckMillis(_lastDutyCycleRequest_millis, ParamHMG_DutyCycleInterval * 1000);
+}
+
+bool HomematicCcu::requestDutyCycle()
+{
+    logDebugP("requestDutyCycle()");
+    _lastDutyCycleRequest_millis = millis();
+
+    String request = ""; // "<?xml version=\"1.0\" encoding=\"UTF-8\"?>";
+    request += "<methodCall>";
+    request += "<methodName>listBidcosInterfaces</methodName>";
+    request += "</methodCall>";
+
+    tinyxml2::XMLDocument doc;
+    if (sendRequestGetResponseDoc(request, doc, false) && processDutyCycleResponse(doc))
+        return true;
+
+    // do not throttle based on outdated values
+    _dutyCycle = -1;
+    return false;
+}
+
+bool HomematicCcu::processDutyCycleResponse(tinyxml2::XMLDocument &doc)
+{
+    // path in xml: //methodResponse/params/param/value/array/data/value[]/struct/member[]/{name,value/i4}
+    tinyxml2::XMLElement *elem = doc.FirstChildElement("methodResponse");
+    elem = elem ? elem->FirstChildElement("params") : nullptr;
+    elem = elem ? elem->FirstChildElement("param") : nullptr;
+    elem = elem ? elem->FirstChildElement("value") : nullptr;
+    elem = elem ? elem->FirstChildElement("array") : nullptr;
+    elem = elem ? elem->FirstChildElement("data") : nullptr;
+    if (elem == nullptr)
+    {
+        logErrorP("Element /methodResponse/params/param/value/array/data is missing!");
+        return false;
+    }
+
+    int32_t dutyCycle = -1;
+    for (tinyxml2::XMLElement *interface = elem->FirstChildElement("value"); interface != nullptr; interface = interface->NextSiblingElement("value"))
+    {
+        tinyxml2::XMLElement *elemStruct = interface->FirstChildElement("struct");
+        if (elemStruct == nullptr)
+            continue;
+
+        for (tinyxml2::XMLElement *member = elemStruct->FirstChildElement("member"); member != nullptr; member = member->NextSiblingElement("member"))
+        {
+            tinyxml2::XMLElement *memberName = member->FirstChildElement("name");
+            tinyxml2::XMLElement *memberValue = member->FirstChildElement("value");
+            if (memberName == nullptr || memberValue == nullptr || memberName->GetText() == nullptr)
+                continue;
+
+            tinyxml2::XMLElement *i4Element = memberValue->FirstChildElement("i4");
+            if (i4Element != nullptr && strcmp(memberName->GetText(), "DUTY_CYCLE") == 0)
+            {
+                // the interface with highest load is limiting
+                dutyCycle = std::max<int32_t>(dutyCycle, i4Element->IntText());
+            }
+        }
+    }
+
+    if (dutyCycle < 0)
+    {
+        logErrorP("DUTY_CYCLE is missing!");
+        return false;
+    }
+
+    _dutyCycle = std::min<int32_t>(dutyCycle, 100);
+    logDebugP("=> DUTY_CYCLE=%d", _dutyCycle);
+    return true;
+}
+
+bool HomematicCcu::isWriteHold()
+{
+    // threshold 0 is disabled
+    return _dutyCycle >= 0 && ParamHMG_DutyCycleHold > 0 && _dutyCycle >= ParamHMG_DutyCycleHold;
+}
+
+bool HomematicCcu::isWriteThrottled()
+{
+    // threshold 0 is disabled
+    return _dutyCycle >= 0 && ParamHMG_DutyCycleThrottle > 0 && _dutyCycle >= ParamHMG_DutyCycleThrottle;
+}
+
+const char *HomematicCcu::writeState()
+{
+    // check hold first, thresholds may be configured in any order
+    return isWriteHold() ? "HOLD" : (isWriteThrottled() ? "THROTTLED" : "OK");
+}
+
+bool HomematicCcu::isWriteAllowed()
+{
+    if (isWriteHold())
+        return false;
+
+    if (!isWriteThrottled())
+        return true;
+
+    return delayCheckMillis(_lastWrite_millis, ParamHMG_DutyCycleThrottleInterval * 1000);
+}
+
+void HomematicCcu::holdWrites()
+{
+    const char *state = writeState();
+    if (!_writesHeld || state != _loggedWriteState)
+    {
+        logInfoP("writing %s (duty-cycle %d%%)", state, _dutyCycle);
+        _loggedWriteState = state;
+        _writesHeld = true;
+    }
+}
+
+void HomematicCcu::resumeWrites()
+{
+    if (_writesHeld)
+    {
+        logInfoP("writing resumed, %s (duty-cycle %d%%)", writeState(), _dutyCycle);
+        _loggedWriteState = nullptr;
+        _writesHeld = false;
+    }
+}
+
+bool HomematicCcu::takeFailureNotice()
+{
+    const bool notice = _failureNotice;
+    _failureNotice = false;
+    return notice;
+}
+
+void HomematicCcu::markSuccess(uint32_t duration_millis)
+{
+    if (_failCount > 0)
+    {
+        logInfoP("reachable again (after %u failed requests)", _failCount);
+    }
+    _everSucceeded = true;
+    _failCount = 0;
+    _retryDelay_millis = 0;
+    _lastDuration_millis = duration_millis;
+}
+
+void HomematicCcu::markFailure()
+{
+    _failCount++;
+    _failureNotice = true;
+    _lastFailure_millis = millis();
+    _retryDelay_millis = (_retryDelay_millis == 0) ? HMG_CcuRetryDelayMin_millis : std::min<uint32_t>(2 * _retryDelay_millis, HMG_CcuRetryDelayMax_millis);
+    logInfoP("request failed %u times, next try in %u s", _failCount, _retryDelay_millis / 1000);
+}
+
+bool HomematicCcu::sendRequestGetResponseDoc(arduino::String &request, tinyxml2::XMLDocument &doc, bool logResponse)
+{
+    const uint32_t tStart = millis();
+    _requestCount++;
+
+    // logDebugP("Read URL POST: http://%s:%d", _host, _port);
+    _http.begin(_host, _port);
+    // keep the connection open for the next request to the same CCU
+    _http.setReuse(true);
+    _http.setTimeout(HMG_CcuTimeout_millis);
+#ifdef ARDUINO_ARCH_ESP32
+    _http.setConnectTimeout(HMG_CcuConnectTimeout_millis);
+#endif
+    _http.addHeader("Content-Type", "text/xml");
+    _http.addHeader("Accept", "text/xml");
+
+    // send value read request
+    int httpStatus = _http.POST(request);
+    if (httpStatus != 200)
+    {
+        _http.end();
+        logErrorP("POST request with status-code %d", httpStatus);
+        markFailure();
+        return false;
+    }
+
+    const uint32_t duration = millis() - tStart;
+    logDebugP("[DONE] duration request %d ms", duration);
+    markSuccess(duration);
+
+    debugLogResponse(logResponse);
+
+    const uint32_t tStart2 = millis();
+    if (doc.Parse(_http.getString().c_str()) != tinyxml2::XML_SUCCESS)
+    {
+        _http.end();
+        logErrorP("Parsing-Error, ID=%d", doc.ErrorID());
+        return false;
+    }
+    logDebugP("[DONE] parse %d ms", millis() - tStart2);
+
+    _http.end();
+
+    logDebugP("[DONE] sendRequestGetResponseDoc %d ms", millis() - tStart);
+    return true;
+}
+
+void HomematicCcu::debugLogResponse(bool logResponse)
+{
+#ifdef OPENKNX_DEBUG
+    if (logResponse)
+    {
+        const uint32_t tStart2 = millis();
+
+        String response = _http.getString();
+        logDebugP("response length: %d", response.length());
+        const size_t len = response.length();
+        const size_t lineLen = 100;
+        for (size_t i = 0; i < len; i += lineLen)
+        {
+            logDebugP("response: %s", response.substring(i, std::min(i + lineLen, len)).c_str());
+        }
+
+        logDebugP("[DONE] duration log response %d ms", millis() - tStart2);
+    }
+#endif
+}
+
+void HomematicCcu::showState()
+{
+    logInfoP("%s:%u", _host, _port);
+    logIndentUp();
+    if (_failCount > 0)
+    {
+        logInfoP("state: FAILING (%u failed requests, retry %s)", _failCount, isAvailable() ? "now" : "waiting");
+    }
+    else
+    {
+        logInfoP("state: %s", _everSucceeded ? "OK" : "unknown");
+    }
+    logInfoP("requests: %u, last duration: %u ms, queued channels: %u", _requestCount, _lastDuration_millis, _queueSize);
+    if (_dutyCycle >= 0)
+    {
+        logInfoP("duty-cycle: %d%% (writing %s)", _dutyCycle, writeState());
+    }
+    else
+    {
+        logInfoP("duty-cycle: unknown");
+    }
+    logIndentDown();
+}
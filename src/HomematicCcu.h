@@ -0,0 +1,101 @@
+// SPDX-License-Identifier: AGPL-3.0-only
+// Copyright (C) 2025 Cornelius Koepp
+
+#pragma once
+#include "OpenKNX.h"
+
+#include "HTTPClient.h"
+#include <tinyxml2.h>
+
+#define HMG_CcuCount 4
+
+// wait time before retry after first failed request; doubled on each further failure
+#define HMG_CcuRetryDelayMin_millis (5 * 1000)
+#define HMG_CcuRetryDelayMax_millis (120 * 1000)
+
+// requests are blocking, so keep timeouts short to limit delay of the whole firmware by a slow or dead CCU
+#define HMG_CcuConnectTimeout_millis 1000
+#define HMG_CcuTimeout_millis 2000
+
+/**
+ * Connection to one CCU (or compatible XML-RPC endpoint) with own request-queue and health state.
+ * Channels do not send their requests directly, but register for processing in the queue of their CCU.
+ * The module serves the CCUs round-robin, one request per loop. Requests are still blocking, so a slow
+ * CCU delays other CCUs by at most one request (limited by timeout), an unreachable CCU is only retried
+ * after increasing delay.
+ */
+class HomematicCcu
+{
+  private:
+    uint8_t _index;
+    const char *_host;
+    uint16_t _port;
+
+    HTTPClient _http;
+
+    // channels waiting for processing of their pending requests (ring-buffer, each channel at most once)
+    uint8_t _queue[HMG_ChannelCount];
+    uint8_t _queueHead = 0;
+    uint8_t _queueSize = 0;
+
+    // health state
+    bool _everSucceeded = false;
+    uint16_t _failCount = 0;
+    uint32_t _lastFailure_millis = 0;
+    uint32_t _retryDelay_millis = 0;
+    uint32_t _lastDuration_millis = 0;
+    uint32_t _requestCount = 0;
+    bool _failureNotice = false;
+
+    // used by at least one channel
+    bool _used = false;
+
+    // RF duty-cycle of interfaces in percent (max of all); -1 for unknown
+    int8_t _dutyCycle = -1;
+    uint32_t _lastDutyCycleRequest_millis = 0;
+    uint32_t _lastWrite_millis = 0;
+    // at least one channel is waiting with writes, outside of queue
+    bool _writesHeld = false;
+    const char *_loggedWriteState = nullptr;
+    bool isWriteHold();
+    const char *writeState();
+    bool processDutyCycleResponse(tinyxml2::XMLDocument &doc);
+
+    void markSuccess(uint32_t duration_millis);
+    void markFailure();
+
+    void debugLogResponse(bool logResponse);
+
+  public:
+    HomematicCcu(uint8_t index, const char *host, uint16_t port);
+    const std::string logPrefix();
+
+    uint8_t index() { return _index; }
+
+    // false while waiting for retry after failed requests
+    bool isAvailable();
+    // true once after a failed request; channels of this CCU will be reported as unreachable
+    bool takeFailureNotice();
+
+    bool enqueue(uint8_t channelIndex);
+    // next channel for processing, when available and not empty; -1 otherwise
+    int16_t dequeue();
+
+    void markUsed() { _used = true; }
+
+    int8_t dutyCycle() { return _dutyCycle; }
+    bool isDutyCycleRequestDue();
+    bool requestDutyCycle();
+    // false while writes are held or throttled because of high duty-cycle; reading is always allowed
+    bool isWriteAllowed();
+    // writes are limited to one setValue per interval; do not combine writes of multiple channels
+    bool isWriteThrottled();
+    void markWrite() { _lastWrite_millis = millis(); }
+    void holdWrites();
+    void resumeWrites();
+    bool hasHeldWrites() { return _writesHeld; }
+
+    bool sendRequestGetResponseDoc(arduino::String &request, tinyxml2::XMLDocument &doc, bool logResponse);
+
+    void showState();
+};
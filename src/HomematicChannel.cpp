@@ -2,6 +2,7 @@
 // Copyright (C) 2024-2025 Cornelius Koepp
 
 #include "HomematicChannel.h"
+#include "HomematicModule.h"
 
 
 #define CHECK_RETURN(element, name, result) \
@@ -14,6 +15,23 @@
 #define CHECK_FALSE(element, name) CHECK_RETURN(element, name, false);
 
 
+// status KOs stored in flash, as int16 with value * scale
+static const struct
+{
+    uint8_t koIndex;
+    Dpt dpt;
+    float scale;
+} HMG_PersistedKos[HMG_PersistedKoCount] = {
+    {HMG_KoKOdTempCurrent, DPT_Value_Temp, 100},
+    {HMG_KoKOdBatteryVultage, DPT_Value_Volt, 1},
+    {HMG_KoKOdBoostState, DPT_State, 1},
+    {HMG_KoKOdError, DPT_Alarm, 1},
+    {HMG_KoKOdTempSetCurrent, DPT_Value_Temp, 100},
+    {HMG_KoKOdValveState, DPT_Scaling, 1},
+    {HMG_KoKOdSignalQuality, DPT_Value_2_Count, 1},
+};
+
+
 HomematicChannel::HomematicChannel(uint8_t index)
 {
     _channelIndex = index;
@@ -35,8 +53,74 @@ void HomematicChannel::setup()
     if (_channelActive)
     {
         _allowedWriting = ParamHMG_dWrite;
-        logDebugP("active (Serial=%s)", ParamHMG_dDeviceSerial);
+        _ccu = openknxHomematicModule.getCcu(ParamHMG_dCcu);
+        logDebugP("active (Serial=%s, CCU=%u)", ParamHMG_dDeviceSerial, _ccu->index() + 1);
         // logDebugP("active (write=%u; serial='%s')", _allowedWriting, ParamHMG_dDeviceSerial);
+        restoreValues(openknxHomematicModule.getRestoredValues(_channelIndex));
+    }
+}
+
+uint16_t HomematicChannel::deviceHash()
+{
+    // djb2, reduced to 16 bit
+    uint16_t hash = 5381 + _ccu->index();
+    for (const char *c = (const char *)ParamHMG_dDeviceSerial; *c != 0; c++)
+    {
+        hash = (hash << 5) + hash + *c;
+    }
+    return hash;
+}
+
+void HomematicChannel::restoreValues(const HomematicChannelValues &values)
+{
+    if (!_channelActive || values.validMask == 0 || values.deviceHash != deviceHash())
+        return;
+
+    // values are available for read requests, but will be sent after first successful update only
+    for (uint8_t i = 0; i < HMG_PersistedKoCount; i++)
+    {
+        if (values.validMask & (1 << i))
+        {
+            const uint8_t koIndex = HMG_PersistedKos[i].koIndex;
+            _koValue[koIndex] = values.values[i] / HMG_PersistedKos[i].scale;
+            _koValid |= 1 << koIndex;
+            knx.getGroupObject(HMG_KoCalcNumber(koIndex)).valueNoSend(_koValue[koIndex], HMG_PersistedKos[i].dpt);
+        }
+    }
+    _valuesStale = true;
+    _restoredAge_minutes = values.age_minutes;
+    logDebugP("restored values (age>=%u min)", values.age_minutes);
+}
+
+void HomematicChannel::writeFlash()
+{
+    // keep layout in sync with HMG_FlashChannelSize and readFlash()
+    uint8_t validMask = 0;
+    for (uint8_t i = 0; i < HMG_PersistedKoCount; i++)
+    {
+        if (_channelActive && (_koValid & (1 << HMG_PersistedKos[i].koIndex)))
+            validMask |= 1 << i;
+    }
+
+    const uint32_t age_minutes = _valuesStale ? (_restoredAge_minutes + millis() / 60000) : ((millis() - _valuesUpdated_millis) / 60000);
+    openknx.flash.writeWord(validMask ? deviceHash() : 0);
+    openknx.flash.writeByte(validMask);
+    openknx.flash.writeWord(std::min<uint32_t>(age_minutes, UINT16_MAX));
+    for (uint8_t i = 0; i < HMG_PersistedKoCount; i++)
+    {
+        const int16_t value = (validMask & (1 << i)) ? round(_koValue[HMG_PersistedKos[i].koIndex] * HMG_PersistedKos[i].scale) : 0;
+        openknx.flash.writeWord(value);
+    }
+}
+
+void HomematicChannel::readFlash(HomematicChannelValues &values)
+{
+    values.deviceHash = openknx.flash.readWord();
+    values.validMask = openknx.flash.readByte();
+    values.age_minutes = openknx.flash.readWord();
+    for (uint8_t i = 0; i < HMG_PersistedKoCount; i++)
+    {
+        values.values[i] = openknx.flash.readWord();
     }
 }
 
@@ -55,21 +139,275 @@ void HomematicChannel::loop()
     // !_channelActive will result in _running=false, so no need for checking
     if (_running)
     {
-        if (delayCheckMillis(_lastRequest_millis, _requestInterval_millis))
+        if (!_pendingUpdate && delayCheckMillis(_lastRequest_millis, _requestInterval_millis))
         {
-            const bool success = update();
-            if (success)
-            {
-                updateRssi();
-            }
-            if (KoHMG_KOdReachable.valueNoSendCompare(success, DPT_Switch))
+            _pendingUpdate = true;
+            enqueueRequests();
+        }
+    }
+}
+
+void HomematicChannel::updateStatusKo(uint8_t koIndex, double value, const Dpt &dpt, double hysteresis)
+{
+    // KO will always answer read requests with the current value
+    knx.getGroupObject(HMG_KoCalcNumber(koIndex)).valueNoSend(value, dpt);
+    _koValue[koIndex] = value;
+    _koValid |= 1 << koIndex;
+
+    const uint16_t koBit = 1 << koIndex;
+    const double diff = std::abs(value - _koSentValue[koIndex]);
+    if (!(_koSent & koBit) || (diff > 0 && diff >= hysteresis))
+    {
+        _koSendPending |= koBit;
+    }
+    else
+    {
+        // back within hysteresis of the last sent value
+        _koSendPending &= ~koBit;
+    }
+}
+
+bool HomematicChannel::processStatusKoSending()
+{
+    if (!_running || _koSendPending == 0)
+        return false;
+
+    const uint32_t minSendInterval_millis = ParamHMG_MinSendInterval * 1000;
+    for (uint8_t koIndex = 0; koIndex < HMG_KoBlockSize; koIndex++)
+    {
+        const uint16_t koBit = 1 << koIndex;
+        if ((_koSendPending & koBit) &&
+            (!(_koSent & koBit) || delayCheckMillis(_koSent_millis[koIndex], minSendInterval_millis)))
+        {
+            // at most one telegram per loop; no more sending, when budget is exhausted
+            if (!openknxHomematicModule.consumeSendBudget())
+                return false;
+
+            knx.getGroupObject(HMG_KoCalcNumber(koIndex)).objectWritten();
+            _koSentValue[koIndex] = _koValue[koIndex];
+            _koSent_millis[koIndex] = millis();
+            _koSent |= koBit;
+            _koSendPending &= ~koBit;
+            if (koIndex != HMG_KoKOdReachable)
             {
-                KoHMG_KOdReachable.objectWritten();
+                openknxHomematicModule.markValuesChanged();
             }
-            _requestInterval_millis = ParamHMG_RequestIntervall * 1000;
-            _lastRequest_millis = millis();
+            return true;
         }
     }
+    return false;
+}
+
+bool HomematicChannel::hasPendingWrites()
+{
+    return _pendingTemperature || _pendingBoost;
+}
+
+void HomematicChannel::requestSetTemperature(double temperature)
+{
+    // only the latest value is relevant, when not sent yet
+    _pendingTemperatureValue = temperature;
+    _pendingTemperature = true;
+    enqueueRequests();
+}
+
+void HomematicChannel::requestBoost(bool boost)
+{
+    _pendingBoostValue = boost;
+    _pendingBoost = true;
+    enqueueRequests();
+}
+
+void HomematicChannel::updateReachable(bool success, bool forceSend)
+{
+    // sending is limited like all status KOs, e.g. after failure of CCU or multicall to many devices
+    updateStatusKo(HMG_KoKOdReachable, success, DPT_Switch);
+    if (forceSend)
+    {
+        _koSendPending |= 1 << HMG_KoKOdReachable;
+    }
+}
+
+bool HomematicChannel::isGroupMember(uint8_t groupIndex)
+{
+    switch (groupIndex)
+    {
+        case 0:
+            return ParamHMG_dGroup1;
+        case 1:
+            return ParamHMG_dGroup2;
+        case 2:
+            return ParamHMG_dGroup3;
+        case 3:
+            return ParamHMG_dGroup4;
+    }
+    return false;
+}
+
+void HomematicChannel::processGroupTemperature(uint8_t groupIndex, double temperature)
+{
+    if (_channelActive && _allowedWriting && isGroupMember(groupIndex))
+    {
+        requestSetTemperature(temperature);
+    }
+}
+
+void HomematicChannel::processGroupBoost(uint8_t groupIndex, bool boost)
+{
+    if (_channelActive && _allowedWriting && isGroupMember(groupIndex))
+    {
+        requestBoost(boost);
+    }
+}
+
+uint8_t HomematicChannel::requestAddPendingWrites(arduino::String &request)
+{
+    uint8_t calls = 0;
+    _writeHeld = false;
+    _multicallTemperature = _pendingTemperature;
+    _multicallBoost = _pendingBoost;
+    if (_pendingTemperature)
+    {
+        logDebugP("Set Device %s Temperature to %.3g (multicall)", ParamHMG_dDeviceSerial, _pendingTemperatureValue);
+        requestAddMulticallSetValue(request, "SET_TEMPERATURE", "double", String(_pendingTemperatureValue));
+        _pendingTemperature = false;
+        calls++;
+    }
+    if (_pendingBoost)
+    {
+        logDebugP("Set Device %s Boost to %s (multicall)", ParamHMG_dDeviceSerial, _pendingBoostValue ? "true" : "false");
+        requestAddMulticallSetValue(request, "BOOST_MODE", "boolean", String(_pendingBoostValue ? 1 : 0));
+        _pendingBoost = false;
+        calls++;
+    }
+    return calls;
+}
+
+void HomematicChannel::processMulticallResults(tinyxml2::XMLElement *&result)
+{
+    // success:  <value><array><data><value>..</value></data></array></value>
+    // fail:     <value><struct><member><name>faultCode</name>..</member>..</struct></value>
+    bool success = true;
+    const uint8_t calls = (_multicallTemperature ? 1 : 0) + (_multicallBoost ? 1 : 0);
+    for (uint8_t i = 0; i < calls; i++)
+    {
+        if (result == nullptr || result->FirstChildElement("array") == nullptr)
+        {
+            logErrorP("multicall: setValue failed!");
+            success = false;
+        }
+        if (result != nullptr)
+        {
+            result = result->NextSiblingElement("value");
+        }
+    }
+
+    if (_multicallBoost)
+    {
+        _requestInterval_millis = ParamHMG_RequestIntervallShort * 1000;
+        _lastRequest_millis = millis();
+    }
+    _multicallTemperature = false;
+    _multicallBoost = false;
+
+    updateReachable(success);
+}
+
+void HomematicChannel::enqueueRequests()
+{
+    // held writes alone are no reason for queueing, channel will be released by module
+    if (!_queued && (_pendingUpdate || (hasPendingWrites() && !_writeHeld)))
+    {
+        _queued = _ccu->enqueue(_channelIndex);
+    }
+}
+
+void HomematicChannel::releaseHeldWrites()
+{
+    _writeHeld = false;
+    enqueueRequests();
+}
+
+void HomematicChannel::requeue()
+{
+    _queued = false;
+    enqueueRequests();
+}
+
+bool HomematicChannel::processQueuedRequest(bool writeAllowed)
+{
+    _queued = false;
+    bool requested = true;
+
+    if (writeAllowed)
+    {
+        _writeHeld = false;
+    }
+    else if (hasPendingWrites())
+    {
+        _writeHeld = true;
+        _ccu->holdWrites();
+    }
+
+    // commands first, as these are triggered by user-interaction
+    if (writeAllowed && _pendingTemperature)
+    {
+        _pendingTemperature = false;
+        _ccu->markWrite();
+        updateReachable(sendSetTemperature(_pendingTemperatureValue));
+    }
+    else if (writeAllowed && _pendingBoost)
+    {
+        _pendingBoost = false;
+        _ccu->markWrite();
+        updateReachable(sendBoost(_pendingBoostValue));
+        _requestInterval_millis = ParamHMG_RequestIntervallShort * 1000;
+        _lastRequest_millis = millis();
+    }
+    else if (_pendingUpdate)
+    {
+        const bool triggered = _pendingUpdateTriggered;
+        _pendingUpdate = false;
+        _pendingUpdateTriggered = false;
+        processUpdate(triggered);
+    }
+    else
+    {
+        requested = false;
+    }
+
+    // remaining requests will be processed after other channels of same CCU
+    enqueueRequests();
+    return requested;
+}
+
+void HomematicChannel::processUpdate(bool triggered)
+{
+    const bool success = update();
+    if (success)
+    {
+        if (_valuesStale)
+        {
+            logDebugP("restored values replaced by update");
+            _valuesStale = false;
+        }
+        _valuesUpdated_millis = millis();
+    }
+    if (triggered)
+    {
+        // answer every trigger
+        updateReachable(success, true);
+    }
+    else
+    {
+        if (success)
+        {
+            updateRssi();
+        }
+        updateReachable(success);
+    }
+    _requestInterval_millis = ParamHMG_RequestIntervall * 1000;
+    _lastRequest_millis = millis();
 }
 
 bool HomematicChannel::update()
@@ -154,17 +492,17 @@ bool HomematicChannel::updateKOsFromMethodResponse(tinyxml2::XMLDocument &doc)
             if (strcmp(pName, "ACTUAL_TEMPERATURE") == 0)
             {
                 logDebugP("=> ACTUAL_TEMPERATURE=%f", value);
-                KoHMG_KOdTempCurrent.valueCompare(value, DPT_Value_Temp);
+                updateStatusKo(HMG_KoKOdTempCurrent, value, DPT_Value_Temp, ParamHMG_HysteresisTemp / 10.0);
             }
             else if (strcmp(pName, "BATTERY_STATE") == 0)
             {
                 logDebugP("=> BATTERY_STATE=%f", value);
-                KoHMG_KOdBatteryVultage.valueCompare(value * 1000, DPT_Value_Volt);
+                updateStatusKo(HMG_KoKOdBatteryVultage, value * 1000, DPT_Value_Volt, ParamHMG_HysteresisBattery * 100.0);
             }
             else if (strcmp(pName, "SET_TEMPERATURE") == 0)
             {
                 logDebugP("=> SET_TEMPERATURE=%f", value);
-                KoHMG_KOdTempSetCurrent.valueCompare(value, DPT_Value_Temp);
+                updateStatusKo(HMG_KoKOdTempSetCurrent, value, DPT_Value_Temp);
             }
             else
             {
@@ -178,17 +516,17 @@ bool HomematicChannel::updateKOsFromMethodResponse(tinyxml2::XMLDocument &doc)
             if (strcmp(pName, "BOOST_STATE") == 0)
             {
                 logDebugP("=> BOOST_STATE=%d", value);
-                KoHMG_KOdBoostState.valueCompare(value, DPT_State);
+                updateStatusKo(HMG_KoKOdBoostState, value, DPT_State);
             }
             else if (strcmp(pName, "FAULT_REPORTING") == 0)
             {
                 logDebugP("=> FAULT_REPORTING=%d", value);
-                KoHMG_KOdError.valueCompare(value, DPT_Alarm);
+                updateStatusKo(HMG_KoKOdError, value, DPT_Alarm);
             }
             else if (strcmp(pName, "VALVE_STATE") == 0)
             {
                 logDebugP("=> VALVE_STATE=%d", value);
-                KoHMG_KOdValveState.valueCompare(value, DPT_Scaling);
+                updateStatusKo(HMG_KoKOdValveState, value, DPT_Scaling, ParamHMG_HysteresisValve);
             }
             else
             {
@@ -280,12 +618,12 @@ bool HomematicChannel::processRssiInfoResponse(tinyxml2::XMLDocument &doc)
 
                 if (rssi1 == 65536 || rssi2 == 65536)
                 {
-                    KoHMG_KOdSignalQuality.valueCompare((int32_t)0x7F, DPT_Value_2_Count);
+                    updateStatusKo(HMG_KoKOdSignalQuality, 0x7F, DPT_Value_2_Count);
                 }
                 else
                 {
                     logDebugP("rssi1=%i / rssi2=%i", rssi1, rssi2);
-                    KoHMG_KOdSignalQuality.valueCompare((rssi1 + rssi2)/2, DPT_Value_2_Count);
+                    updateStatusKo(HMG_KoKOdSignalQuality, (rssi1 + rssi2)/2, DPT_Value_2_Count);
                 }
 
                 logIndentDown();
@@ -311,8 +649,7 @@ void HomematicChannel::processInputKo(GroupObject &ko)
         {
             if (_allowedWriting)
             {
-                const double temperature = KoHMG_KOdTempSet.value(DPT_Value_Temp);
-                sendSetTemperature(temperature);
+                requestSetTemperature(KoHMG_KOdTempSet.value(DPT_Value_Temp));
             }
             break;
         }
@@ -320,9 +657,7 @@ void HomematicChannel::processInputKo(GroupObject &ko)
         {
             if (_allowedWriting)
             {
-                sendBoost(KoHMG_KOdBoostTrigger.value(DPT_Trigger));
-                _requestInterval_millis = ParamHMG_RequestIntervallShort * 1000;
-                _lastRequest_millis = millis();
+                requestBoost(KoHMG_KOdBoostTrigger.value(DPT_Trigger));
             }
             break;
         }        
@@ -330,10 +665,9 @@ void HomematicChannel::processInputKo(GroupObject &ko)
         {
             if (KoHMG_KOdTriggerRequest.value(DPT_Trigger))
             {
-                const bool success = update();
-                KoHMG_KOdReachable.value(success, DPT_Switch);
-                _requestInterval_millis = ParamHMG_RequestIntervall * 1000;
-                _lastRequest_millis = millis();
+                _pendingUpdate = true;
+                _pendingUpdateTriggered = true;
+                enqueueRequests();
             }
             break;
         }  
@@ -342,10 +676,31 @@ void HomematicChannel::processInputKo(GroupObject &ko)
 
 bool HomematicChannel::processCommandOverview()
 {
-    return false;
+    if (!_channelActive)
+    {
+        logInfoP("inactive");
+        return true;
+    }
+
+    logInfoP("Serial=%s, CCU=%u", ParamHMG_dDeviceSerial, _ccu->index() + 1);
+    logIndentUp();
+    if (_valuesStale)
+    {
+        logInfoP("values: STALE (restored from flash, age>=%u min)", _restoredAge_minutes + millis() / 60000);
+    }
+    else if (_koValid != 0)
+    {
+        logInfoP("values: updated %u s ago", (millis() - _valuesUpdated_millis) / 1000);
+    }
+    else
+    {
+        logInfoP("values: none");
+    }
+    logIndentDown();
+    return true;
 }
 
-void HomematicChannel::sendSetTemperature(double targetTemperature)
+bool HomematicChannel::sendSetTemperature(double targetTemperature)
 {
     logDebugP("sendSetTemperature(%.3g)", targetTemperature);
 
@@ -361,10 +716,10 @@ void HomematicChannel::sendSetTemperature(double targetTemperature)
 
     logDebugP("Set Device %s Temperature to %.3g", ParamHMG_dDeviceSerial, targetTemperature);
 
-    sendRequestCheckResponseOk(request);
+    return sendRequestCheckResponseOk(request);
 }
 
-void HomematicChannel::sendBoost(bool boost)
+bool HomematicChannel::sendBoost(bool boost)
 {
     logDebugP("sendBoost(%s)", boost ? "true" : "false");
 
@@ -380,7 +735,7 @@ void HomematicChannel::sendBoost(bool boost)
 
     logDebugP("Set Device %s Boost to %s", ParamHMG_dDeviceSerial, boost ? "true" : "false");
 
-    sendRequestCheckResponseOk(request);
+    return sendRequestCheckResponseOk(request);
 }
 
 void HomematicChannel::requestAddParamString(arduino::String &request, const char *str)
@@ -390,11 +745,17 @@ void HomematicChannel::requestAddParamString(arduino::String &request, const cha
     request += "</string></value></param>";
 }
 
-void HomematicChannel::requestAddParamDeviceSerial(arduino::String &request)
+void HomematicChannel::requestAddDeviceAddress(arduino::String &request)
 {
-    request += "<param><value><string>";
+    // address of device channel; values of HM-CC-RT-DN are in channel 4
     request += (const char *)ParamHMG_dDeviceSerial; //"OEQ1234567";
     request += ":4";
+}
+
+void HomematicChannel::requestAddParamDeviceSerial(arduino::String &request)
+{
+    request += "<param><value><string>";
+    requestAddDeviceAddress(request);
     request += "</string></value></param>";
 }
 
@@ -419,60 +780,33 @@ void HomematicChannel::requestAddParamBoolean(arduino::String &request, boolean
     request += "</boolean></value></param>";
 }
 
-bool HomematicChannel::sendRequestGetResponseDoc(arduino::String &request, tinyxml2::XMLDocument &doc)
+void HomematicChannel::requestAddMulticallSetValue(arduino::String &request, const char *valueKey, const char *type, const arduino::String &value)
 {
-    const uint32_t tStart = millis();
+    // <value><struct>{methodName, params}</struct></value> as element of system.multicall array
+    request += "<value><struct>";
+    request += "<member><name>methodName</name><value><string>setValue</string></value></member>";
+    request += "<member><name>params</name><value><array><data>";
+    request += "<value><string>";
+    requestAddDeviceAddress(request);
+    request += "</string></value>";
+    request += "<value><string>";
+    request += valueKey;
+    request += "</string></value>";
+    request += "<value><";
+    request += type;
+    request += ">";
+    request += value;
+    request += "</";
+    request += type;
+    request += "></value>";
+    request += "</data></array></value></member>";
+    request += "</struct></value>";
+}
 
+bool HomematicChannel::sendRequestGetResponseDoc(arduino::String &request, tinyxml2::XMLDocument &doc)
+{
     logDebugP("Device Serial: %s", ParamHMG_dDeviceSerial);
-    // logDebugP("Read URL POST: http://%s:%d", (const char *)ParamHMG_Host, ParamHMG_Port);
-
-    HTTPClient http;
-    /*
-    // TODO check moving to module
-    String url = "http://";
-    url += (const char *)ParamHMG_Host;
-    url += ":";
-    url += ParamHMG_Port;
-
-#ifdef ARDUINO_ARCH_RP2040
-    if (url.startsWith("https://"))
-        http.setInsecure();
-#endif
-    http.begin(url);
-    */
-
-    http.begin((const char *)ParamHMG_Host, ParamHMG_Port);
-    // TODO check using reuse of the connection; needs moving to model
-    http.setReuse(false);
-    http.addHeader("Content-Type", "text/xml");
-    http.addHeader("Accept", "text/xml");
-
-    // send value read request
-    int httpStatus = http.POST(request);
-    if (httpStatus != 200)
-    {
-        http.end();
-        logErrorP("POST request with status-code %d", httpStatus);
-        return false;
-    }
-
-    logDebugP("[DONE] duration request %d ms", millis() - tStart);
-
-    debugLogResponse(http);
-
-    const uint32_t tStart3 = millis();
-    if (doc.Parse(http.getString().c_str()) != tinyxml2::XML_SUCCESS)
-    {
-        http.end();
-        logErrorP("Parsing-Error, ID=%d", doc.ErrorID());
-        return false;
-    }
-    logDebugP("[DONE] parse %d ms", millis() - tStart3);
-
-    http.end();
-
-    logDebugP("[DONE] sendRequest2 %d ms", millis() - tStart2);
-    return true;
+    return _ccu->sendRequestGetResponseDoc(request, doc, _logResponse);
 }
 
 bool HomematicChannel::sendRequestCheckResponseOk(arduino::String &request)
@@ -525,24 +859,3 @@ bool HomematicChannel::checkSendRequestResponse(tinyxml2::XMLDocument &doc)
     logDebugP("[DONE] checkSendRequestResponse() in %d ms", millis() - tStart);
     return true;
 }
-
-void HomematicChannel::debugLogResponse(HTTPClient &http)
-{
-#ifdef OPENKNX_DEBUG
-    if (_logResponse)
-    {
-        const uint32_t tStart2 = millis();
-
-        String response = http.getString();
-        logDebugP("response length: %d", response.length());
-        const size_t len = response.length();
-        const size_t lineLen = 100;
-        for (size_t i = 0; i < len; i += lineLen)
-        {
-            logDebugP("response: %s", response.substring(i, std::min(i + lineLen, len)).c_str());
-        }
-
-        logDebugP("[DONE] duration log response %d ms", millis() - tStart2);
-    }
-#endif
-}
@@ -2,11 +2,30 @@
 // Copyright (C) 2024-2025 Cornelius Koepp
 
 #pragma once
+#include "HomematicCcu.h"
 #include "OpenKNX.h"
 
-#include "HTTPClient.h"
 #include <tinyxml2.h>
 
+// status KOs with values stored in flash
+#define HMG_PersistedKoCount 7
+
+/**
+ * Last known status values of a channel, as stored in flash
+ */
+struct HomematicChannelValues
+{
+    // identifies device and CCU, to ignore values after changing configuration
+    uint16_t deviceHash;
+    // bit n is set, when values[n] is valid
+    uint8_t validMask;
+    // age of values when stored
+    uint16_t age_minutes;
+    // scaled values, see HMG_PersistedKos
+    int16_t values[HMG_PersistedKoCount];
+};
+#define HMG_FlashChannelSize (2 + 1 + 2 + 2 * HMG_PersistedKoCount)
+
 class HomematicChannel : public OpenKNX::Channel
 {
   private:
@@ -24,26 +43,67 @@ class HomematicChannel : public OpenKNX::Channel
 
     bool _logResponse = false;
 
+    // CCU used for communication with the device
+    HomematicCcu *_ccu = nullptr;
+
+    // requests waiting for processing by CCU
+    bool _queued = false;
+    bool _pendingUpdate = false;
+    bool _pendingUpdateTriggered = false;
+    bool _pendingTemperature = false;
+    double _pendingTemperatureValue = 0;
+    bool _pendingBoost = false;
+    bool _pendingBoostValue = false;
+    // pending writes are not allowed by CCU; channel is not queued for these
+    bool _writeHeld = false;
+
+    // status KOs: current value is always updated, sending is limited by hysteresis, interval and module budget
+    double _koValue[HMG_KoBlockSize] = {};
+    double _koSentValue[HMG_KoBlockSize] = {};
+    uint32_t _koSent_millis[HMG_KoBlockSize] = {};
+    uint16_t _koSent = 0;
+    uint16_t _koSendPending = 0;
+    uint16_t _koValid = 0;
+
+    // values are restored from flash and not confirmed by device yet
+    bool _valuesStale = false;
+    uint16_t _restoredAge_minutes = 0;
+    uint32_t _valuesUpdated_millis = 0;
+
+    uint16_t deviceHash();
+
+    void updateStatusKo(uint8_t koIndex, double value, const Dpt &dpt, double hysteresis = 0);
+
+    // writes included in current multicall
+    bool _multicallTemperature = false;
+    bool _multicallBoost = false;
+
+    void enqueueRequests();
+    void requestSetTemperature(double temperature);
+    void requestBoost(bool boost);
+    bool isGroupMember(uint8_t groupIndex);
+    void processUpdate(bool triggered);
+
     bool update();
     bool updateRssi();
     tinyxml2::XMLElement* getMethodResponseMember(tinyxml2::XMLDocument &doc);
     bool updateKOsFromMethodResponse(tinyxml2::XMLDocument &doc);
     bool processRssiInfoResponse(tinyxml2::XMLDocument &doc);
-    void sendSetTemperature(double targetTemperature);
-    void sendBoost(bool boost);
+    bool sendSetTemperature(double targetTemperature);
+    bool sendBoost(bool boost);
 
+    void requestAddDeviceAddress(arduino::String &request);
     void requestAddParamDeviceSerial(arduino::String &request);
     void requestAddParamString(arduino::String &request, const char *str);
     void requestAddParamDouble(arduino::String &request, double value);
     void requestAddParamInteger4(arduino::String &request, int32_t i4Value);
     void requestAddParamBoolean(arduino::String &request, boolean Value);
+    void requestAddMulticallSetValue(arduino::String &request, const char *valueKey, const char *type, const arduino::String &value);
 
     bool sendRequestGetResponseDoc(arduino::String &request, tinyxml2::XMLDocument &doc);
     bool sendRequestCheckResponseOk(arduino::String &request);
     bool checkSendRequestResponse(tinyxml2::XMLDocument &doc);
 
-    void debugLogResponse(HTTPClient &http);
-
   public:
     explicit HomematicChannel(uint8_t index);
     const std::string name() override;
@@ -52,5 +112,33 @@ class HomematicChannel : public OpenKNX::Channel
     void processAfterStartupDelay();
     void processInputKo(GroupObject &ko) override;
 
+    // process one pending request; called by module when the channel is next in queue of its CCU
+    // pending writes are kept for later, when not allowed; returns true when a request was sent
+    bool processQueuedRequest(bool writeAllowed = true);
+    // dequeued without processing; register again for remaining requests
+    void requeue();
+
+    HomematicCcu *ccu() { return _ccu; }
+    bool hasPendingWrites();
+    void updateReachable(bool success, bool forceSend = false);
+    bool isWriteHeld() { return _writeHeld; }
+    // writes are allowed again; register for processing
+    void releaseHeldWrites();
+    // add pending writes as calls to system.multicall; returns the number of added calls
+    uint8_t requestAddPendingWrites(arduino::String &request);
+    // process results of calls added before; result is moved to the first result of next channel
+    void processMulticallResults(tinyxml2::XMLElement *&result);
+
+    void processGroupTemperature(uint8_t groupIndex, double temperature);
+    void processGroupBoost(uint8_t groupIndex, bool boost);
+
     bool processCommandOverview();
+
+    // send at most one pending status KO, when allowed by interval and module budget; true if sent
+    bool processStatusKoSending();
+
+    // restore values read from flash; independent of call order of setup() and readFlash()
+    void restoreValues(const HomematicChannelValues &values);
+    void writeFlash();
+    static void readFlash(HomematicChannelValues &values);
 };
\ No newline at end of file
@@ -3,6 +3,9 @@
 
 #include "HomematicModule.h"
 
+// increase on changing layout of flash data
+#define HMG_FlashVersion 1
+
 HomematicModule::HomematicModule()
 {
 }
@@ -21,6 +24,17 @@ void HomematicModule::setup()
 {
     logDebugP("setup");
     logIndentUp();
+    _ccuCount = ParamHMG_CcuCount;
+    _sendBudget = ParamHMG_SendBudget;
+    _sendTokens = _sendBudget;
+    if (_sendBudget > 0)
+    {
+        _sendTokenInterval_millis = ParamHMG_SendBudgetWindow * 1000 / _sendBudget;
+    }
+    _ccus[0] = new HomematicCcu(0, (const char *)ParamHMG_Host, ParamHMG_Port);
+    _ccus[1] = new HomematicCcu(1, (const char *)ParamHMG_Ccu2Host, ParamHMG_Ccu2Port);
+    _ccus[2] = new HomematicCcu(2, (const char *)ParamHMG_Ccu3Host, ParamHMG_Ccu3Port);
+    _ccus[3] = new HomematicCcu(3, (const char *)ParamHMG_Ccu4Host, ParamHMG_Ccu4Port);
     for (uint8_t i = 0; i < HMG_ChannelCount; i++)
     {
         _channels[i] = new HomematicChannel(i);
@@ -32,6 +46,7 @@ void HomematicModule::setup()
 void HomematicModule::processAfterStartupDelay()
 {
     logDebugP("processAfterStartupDelay");
+    _running = true;
     logIndentUp();
     for (uint8_t i = 0; i < HMG_ChannelCount; i++)
     {
@@ -42,6 +57,8 @@ void HomematicModule::processAfterStartupDelay()
 
 void HomematicModule::loop()
 {
+    refillSendBudget();
+
     // TODO optimize
     for (uint8_t i = 0; i < HMG_ChannelCount; i++)
     {
@@ -49,10 +66,206 @@ void HomematicModule::loop()
         _channels[i]->loop();
         RUNTIME_MEASURE_END(_channelLoopRuntimes[i]);
     }
+
+    processStatusKoSending();
+
+    // at most one (blocking) request in each loop; CCUs take turns, idle CCUs are skipped
+    for (uint8_t n = 0; n < _ccuCount; n++)
+    {
+        HomematicCcu *ccu = _ccus[_nextCcuIdx];
+        _nextCcuIdx = (_nextCcuIdx + 1) % _ccuCount;
+        const bool served = processCcu(ccu);
+        if (ccu->takeFailureNotice())
+        {
+            reportCcuFailure(ccu);
+        }
+        if (served)
+            break;
+    }
+
+    // limit flash writes; values will also be saved by common before restart
+    if (_valuesChanged && ParamHMG_FlashSaveInterval > 0 && delayCheckMillis(_lastFlashSave_millis, ParamHMG_FlashSaveInterval * 60000))
+    {
+        logDebugP("save values to flash");
+        _valuesChanged = false;
+        _lastFlashSave_millis = millis();
+        openknx.flash.save();
+    }
+}
+
+void HomematicModule::reportCcuFailure(HomematicCcu *ccu)
+{
+    // queued channels will not be served during retry delay, so report all devices of this CCU directly
+    for (uint8_t i = 0; i < HMG_ChannelCount; i++)
+    {
+        if (_channels[i]->ccu() == ccu)
+            _channels[i]->updateReachable(false);
+    }
+}
+
+bool HomematicModule::processCcu(HomematicCcu *ccu)
+{
+    if (ccu->hasHeldWrites() && ccu->isWriteAllowed())
+    {
+        ccu->resumeWrites();
+        for (uint8_t i = 0; i < HMG_ChannelCount; i++)
+        {
+            if (_channels[i]->ccu() == ccu && _channels[i]->isWriteHeld())
+                _channels[i]->releaseHeldWrites();
+        }
+    }
+
+    if (_running && ccu->isDutyCycleRequestDue())
+    {
+        if (ccu->requestDutyCycle())
+        {
+            if (knx.getGroupObject(HMG_KoKOCcu1DutyCycle + ccu->index()).valueNoSendCompare(ccu->dutyCycle(), DPT_Scaling))
+            {
+                _dutyCycleKoSendPending |= 1 << ccu->index();
+            }
+        }
+        return true;
+    }
+    return processCcuQueue(ccu);
+}
+
+bool HomematicModule::processCcuQueue(HomematicCcu *ccu)
+{
+    const int16_t channelIdx = ccu->dequeue();
+    if (channelIdx < 0)
+        return false;
+
+    const bool writeAllowed = ccu->isWriteAllowed();
+
+    // combine writes of multiple channels in one request, e.g. after group commands;
+    // not on high duty-cycle, as the CCU would send all RF commands at once
+    uint8_t writingChannels = 0;
+    if (writeAllowed && !ccu->isWriteThrottled() && _channels[channelIdx]->hasPendingWrites())
+    {
+        for (uint8_t i = 0; i < HMG_ChannelCount; i++)
+        {
+            if (_channels[i]->ccu() == ccu && _channels[i]->hasPendingWrites())
+                writingChannels++;
+        }
+    }
+
+    if (writingChannels > 1)
+    {
+        processCcuWrites(ccu);
+        // remaining requests of dequeued channel will be processed on its next turn
+        _channels[channelIdx]->requeue();
+        return true;
+    }
+
+    RUNTIME_MEASURE_BEGIN(_channelLoopRuntimes[channelIdx]);
+    const bool requested = _channels[channelIdx]->processQueuedRequest(writeAllowed);
+    RUNTIME_MEASURE_END(_channelLoopRuntimes[channelIdx]);
+    return requested;
+}
+
+void HomematicModule::processCcuWrites(HomematicCcu *ccu)
+{
+    const uint32_t tStart = millis();
+
+    String request = ""; // "<?xml version=\"1.0\" encoding=\"UTF-8\"?>";
+    request += "<methodCall>";
+    request += "<methodName>system.multicall</methodName>";
+    request += "<params><param><value><array><data>";
+    bool included[HMG_ChannelCount] = {};
+    uint8_t calls = 0;
+    for (uint8_t i = 0; i < HMG_ChannelCount; i++)
+    {
+        if (_channels[i]->ccu() == ccu && _channels[i]->hasPendingWrites())
+        {
+            calls += _channels[i]->requestAddPendingWrites(request);
+            included[i] = true;
+        }
+    }
+    request += "</data></array></value></param></params>";
+    request += "</methodCall>";
+
+    logDebugP("multicall with %u calls to CCU %u", calls, ccu->index() + 1);
+    ccu->markWrite();
+
+    // path in xml: //methodResponse/params/param/value/array/data/value[]
+    tinyxml2::XMLElement *result = nullptr;
+    tinyxml2::XMLDocument doc;
+    if (ccu->sendRequestGetResponseDoc(request, doc, false))
+    {
+        tinyxml2::XMLElement *elem = doc.FirstChildElement("methodResponse");
+        elem = elem ? elem->FirstChildElement("params") : nullptr;
+        elem = elem ? elem->FirstChildElement("param") : nullptr;
+        elem = elem ? elem->FirstChildElement("value") : nullptr;
+        elem = elem ? elem->FirstChildElement("array") : nullptr;
+        elem = elem ? elem->FirstChildElement("data") : nullptr;
+        result = elem ? elem->FirstChildElement("value") : nullptr;
+        if (result == nullptr)
+        {
+            logErrorP("multicall failed, no results!");
+        }
+    }
+
+    // results are in same order as calls
+    for (uint8_t i = 0; i < HMG_ChannelCount; i++)
+    {
+        if (included[i])
+        {
+            _channels[i]->processMulticallResults(result);
+        }
+    }
+
+    logDebugP("[DONE] multicall %d ms", millis() - tStart);
+}
+
+uint16_t HomematicModule::flashSize()
+{
+    return 1 + HMG_ChannelCount * HMG_FlashChannelSize;
+}
+
+void HomematicModule::readFlash(const uint8_t *data, const uint16_t size)
+{
+    // ignore missing data or data written by other version
+    if (size != flashSize())
+        return;
+
+    if (openknx.flash.readByte() != HMG_FlashVersion)
+        return;
+
+    logDebugP("read values from flash");
+    for (uint8_t i = 0; i < HMG_ChannelCount; i++)
+    {
+        HomematicChannel::readFlash(_restoredValues[i]);
+        // after setup: restore directly; otherwise the channel will restore in its setup()
+        if (_channels[i] != nullptr)
+        {
+            _channels[i]->restoreValues(_restoredValues[i]);
+        }
+    }
+}
+
+void HomematicModule::writeFlash()
+{
+    openknx.flash.writeByte(HMG_FlashVersion);
+    for (uint8_t i = 0; i < HMG_ChannelCount; i++)
+    {
+        if (_channels[i] != nullptr)
+        {
+            _channels[i]->writeFlash();
+        }
+        else
+        {
+            // not configured: keep size, without valid values
+            for (uint8_t j = 0; j < HMG_FlashChannelSize; j++)
+                openknx.flash.writeByte(0);
+        }
+    }
 }
 
 void HomematicModule::processInputKo(GroupObject &ko)
 {
+    if (processGroupInputKo(ko))
+        return;
+
     for (uint8_t i = 0; i < HMG_ChannelCount; i++)
     {
         RUNTIME_MEASURE_BEGIN(_channelInputRuntimes[i]);
@@ -61,39 +274,123 @@ void HomematicModule::processInputKo(GroupObject &ko)
     }
 }
 
+bool HomematicModule::processGroupInputKo(GroupObject &ko)
+{
+    // group KOs are ordered by group: {TempSet, BoostTrigger}[HMG_GroupCount]
+    const uint16_t asap = ko.asap();
+    if (!ParamHMG_GroupsActive || asap < HMG_KoKOGroup1TempSet || asap >= HMG_KoKOGroup1TempSet + 2 * HMG_GroupCount)
+        return false;
+
+    const uint8_t groupIndex = (asap - HMG_KoKOGroup1TempSet) / 2;
+    if ((asap - HMG_KoKOGroup1TempSet) % 2 == 0)
+    {
+        const double temperature = ko.value(DPT_Value_Temp);
+        logDebugP("group %u: set temperature %.3g", groupIndex + 1, temperature);
+        for (uint8_t i = 0; i < HMG_ChannelCount; i++)
+        {
+            _channels[i]->processGroupTemperature(groupIndex, temperature);
+        }
+    }
+    else
+    {
+        const bool boost = ko.value(DPT_Trigger);
+        logDebugP("group %u: boost %u", groupIndex + 1, boost);
+        for (uint8_t i = 0; i < HMG_ChannelCount; i++)
+        {
+            _channels[i]->processGroupBoost(groupIndex, boost);
+        }
+    }
+    return true;
+}
+
+HomematicCcu *HomematicModule::getCcu(uint8_t ccuIndex)
+{
+    if (ccuIndex >= _ccuCount)
+    {
+        logErrorP("CCU %u is not configured, use CCU 1!", ccuIndex + 1);
+        ccuIndex = 0;
+    }
+    _ccus[ccuIndex]->markUsed();
+    return _ccus[ccuIndex];
+}
+
+void HomematicModule::refillSendBudget()
+{
+    if (_sendTokens >= _sendBudget)
+    {
+        // full; start refill interval with first consumption
+        _lastSendTokenRefill_millis = millis();
+        return;
+    }
+
+    while (_sendTokens < _sendBudget && delayCheckMillis(_lastSendTokenRefill_millis, _sendTokenInterval_millis))
+    {
+        _sendTokens++;
+        _lastSendTokenRefill_millis += _sendTokenInterval_millis;
+    }
+}
+
+void HomematicModule::processStatusKoSending()
+{
+    // diagnostic KOs are limited by the same budget
+    for (uint8_t c = 0; c < _ccuCount && _dutyCycleKoSendPending != 0; c++)
+    {
+        if ((_dutyCycleKoSendPending & (1 << c)) && consumeSendBudget())
+        {
+            knx.getGroupObject(HMG_KoKOCcu1DutyCycle + c).objectWritten();
+            _dutyCycleKoSendPending &= ~(1 << c);
+        }
+    }
+
+    // start after the last channel which has sent, so no channel will be preferred on exhausted budget
+    int16_t lastSentIdx = -1;
+    for (uint8_t n = 0; n < HMG_ChannelCount; n++)
+    {
+        const uint8_t i = (_nextSendChannelIdx + n) % HMG_ChannelCount;
+        if (_channels[i]->processStatusKoSending())
+            lastSentIdx = i;
+    }
+    if (lastSentIdx >= 0)
+    {
+        _nextSendChannelIdx = (lastSentIdx + 1) % HMG_ChannelCount;
+    }
+}
+
+bool HomematicModule::consumeSendBudget()
+{
+    if (_sendBudget == 0)
+        return true;
+
+    if (_sendTokens == 0)
+        return false;
+
+    _sendTokens--;
+    return true;
+}
+
 void HomematicModule::showHelp()
 {
     // TODO Check and refine command definitions after first tests and extension!
     openknx.console.printHelpLine("hmgNN",          "Device overview");
     openknx.console.printHelpLine("hmgNN update",   "Update device state");
     openknx.console.printHelpLine("hmgNN temp=CC",  "Set target temperature");
+    openknx.console.printHelpLine("hmg ccu",        "CCU connection state");
 }
 
 bool HomematicModule::processCommand(const std::string cmd, bool diagnoseKo)
 {
     if (cmd.substr(0, 3) == "hmg")
     {
-        if (cmd.length() >= 5)
+        if (cmd == "hmg ccu")
         {
-            if (!std::isdigit(cmd[3]) || !std::isdigit(cmd[4]))
-            {
-                logErrorP("=> invalid channel-number '%s'!", cmd.substr(3, 2).c_str());
-                return false;
-            }
-
-            const uint16_t channelIdx = std::stoi(cmd.substr(3, 2)) - 1;
-            if (channelIdx < HMG_ChannelCount)
-            {
-                if (cmd.length() == 5)
-                {
-                    logDebugP("=> Channel<%u> overview!", (channelIdx + 1));
-                    return _channels[channelIdx]->processCommandOverview();
-                }
-            }
-            else
+            logInfoP("HMG CCU State:");
+            logIndentUp();
+            for (uint8_t c = 0; c < _ccuCount; c++)
             {
-                logInfoP("=> unused channel-number %u!", channelIdx + 1);
+                _ccus[c]->showState();
             }
+            logIndentDown();
+            return true;
         }
 #ifdef OPENKNX_RUNTIME_STAT
         else if (cmd == "hmg runtime")
@@ -113,6 +410,28 @@ bool HomematicModule::processCommand(const std::string cmd, bool diagnoseKo)
             logIndentDown();
         }
 #endif
+        else if (cmd.length() >= 5)
+        {
+            if (!std::isdigit(cmd[3]) || !std::isdigit(cmd[4]))
+            {
+                logErrorP("=> invalid channel-number '%s'!", cmd.substr(3, 2).c_str());
+                return false;
+            }
+
+            const uint16_t channelIdx = std::stoi(cmd.substr(3, 2)) - 1;
+            if (channelIdx < HMG_ChannelCount)
+            {
+                if (cmd.length() == 5)
+                {
+                    logDebugP("=> Channel<%u> overview!", (channelIdx + 1));
+                    return _channels[channelIdx]->processCommandOverview();
+                }
+            }
+            else
+            {
+                logInfoP("=> unused channel-number %u!", channelIdx + 1);
+            }
+        }
     }
     return false;
 }
@@ -2,15 +2,47 @@
 // Copyright (C) 2024 Cornelius Koepp
 
 #pragma once
+#include "HomematicCcu.h"
 #include "HomematicChannel.h"
 #include "OpenKNX.h"
 // always include for RUNTIME_MEASURE_{BEGIN,END}
 #include "OpenKNX/Stat/RuntimeStat.h"
 
+// groups for controlling multiple channels by one KO
+#define HMG_GroupCount 4
+
 class HomematicModule : public OpenKNX::Module
 {
   private:
-    HomematicChannel *_channels[HMG_ChannelCount];
+    HomematicCcu *_ccus[HMG_CcuCount];
+    uint8_t _ccuCount = 1;
+    // CCU to serve first in next loop (round-robin)
+    uint8_t _nextCcuIdx = 0;
+    bool _running = false;
+    HomematicChannel *_channels[HMG_ChannelCount] = {};
+
+    // budget for sending status KOs (token bucket); no limit for _sendBudget == 0
+    uint8_t _sendBudget = 0;
+    uint8_t _sendTokens = 0;
+    uint32_t _sendTokenInterval_millis = 0;
+    uint32_t _lastSendTokenRefill_millis = 0;
+    // channel to get the first chance for sending in next loop (round-robin)
+    uint8_t _nextSendChannelIdx = 0;
+    // duty-cycle KOs waiting for sending (bit per CCU)
+    uint8_t _dutyCycleKoSendPending = 0;
+    void refillSendBudget();
+    void processStatusKoSending();
+
+    bool processCcu(HomematicCcu *ccu);
+    void reportCcuFailure(HomematicCcu *ccu);
+    bool processCcuQueue(HomematicCcu *ccu);
+    void processCcuWrites(HomematicCcu *ccu);
+    bool processGroupInputKo(GroupObject &ko);
+
+    // persisted values of channels, as read from flash
+    HomematicChannelValues _restoredValues[HMG_ChannelCount] = {};
+    bool _valuesChanged = false;
+    uint32_t _lastFlashSave_millis = 0;
 #ifdef OPENKNX_RUNTIME_STAT
     OpenKNX::Stat::RuntimeStat _channelLoopRuntimes[HMG_ChannelCount];
     OpenKNX::Stat::RuntimeStat _channelInputRuntimes[HMG_ChannelCount];
@@ -28,6 +60,18 @@ class HomematicModule : public OpenKNX::Module
 
     void processInputKo(GroupObject &ko) override;
 
+    uint16_t flashSize() override;
+    void readFlash(const uint8_t *data, const uint16_t size) override;
+    void writeFlash() override;
+
+    HomematicCcu *getCcu(uint8_t ccuIndex);
+    // true, when sending of one status telegram is allowed now
+    bool consumeSendBudget();
+
+    const HomematicChannelValues &getRestoredValues(uint8_t channelIndex) { return _restoredValues[channelIndex]; }
+    // request saving of changed channel values, limited by configured interval
+    void markValuesChanged() { _valuesChanged = true; }
+
     void showHelp() override;
     bool processCommand(const std::string cmd, bool diagnoseKo);
 };